@@ -5,11 +5,13 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <myo/myo.hpp>
 #include <windows.h>
 
 const int BUFFER_SAMPLES = 200;
 const int PARAM_COUNT = (8 + 3 + 4);		// 8-EMG, 3-Acc, 4-Ori
+const uint64_t FUSION_GAP_US = 100000;		// Stream silence (us) treated as a dropout
 
 using namespace std;
 ofstream myfile;
@@ -19,19 +21,31 @@ private:
 	bool debug = true;
 	int bufferLen = BUFFER_SAMPLES;
 	int bufferPosEMG = 0;
-	int bufferPosAcc = 0;
-	int bufferPosOri = 0;
 	int bufferPosProb = 0;
+	// Fused history on the EMG sample grid (Acc/Ori held at each EMG timestamp)
 	int8_t **emgSamples;
 	myo::Vector3<float> *accSamples;
 	myo::Quaternion<float> *oriSamples;
 	bool grasping = false;
 	int acquiredEMGSamples = 0;
-	int acquiredAccSamples = 0;
+	int alignedSamples = 0;		// Contiguous fused samples since start or last gap
+	bool gap = false;
+	bool historyReset = false;	// Last EMG sample restarted the history (dropout or stale IMU)
+	uint64_t lastEMGTime = 0;
+	// Latest two samples of each IMU stream ([1] newest) for sample-and-hold
+	myo::Vector3<float> accHeld[2];
+	myo::Quaternion<float> oriHeld[2];
+	uint64_t accHeldTime[2] = { 0, 0 };
+	uint64_t oriHeldTime[2] = { 0, 0 };
+	int accHeldCount = 0;
+	int oriHeldCount = 0;
 	// Beta parameters for logistic regression
 	bool trained = false;
 	int probSmoothing, stepbacks;
-	float *beta;				// Excess parameters will simply not be employed
+	float *beta = nullptr;		// Excess parameters will simply not be employed
+	float *features = nullptr;	// Shared lag feature vector, built once per EMG sample
+	int featureLags = 0;		// Lags held in features: max(stepbacks, requestedLags)
+	int requestedLags = 0;		// Extra history requested by the model bank
 	float *bufferProb;
 	int betacount;
 	// Refractory period for stimulation switching
@@ -54,6 +68,7 @@ public:
 		// Ensure probability buffer set to all zeros
 		for (int k = 0; k < BUFFER_SAMPLES; k++)
 			bufferProb[k] = 0;
+		resizeFeatures();
 	}
 
 	// Destructor
@@ -65,6 +80,8 @@ public:
 		delete[] oriSamples;
 		if (beta!=nullptr)
 			delete[] beta;
+		if (features != nullptr)
+			delete[] features;
 	}
 
 	// Dynamically allocate beta list
@@ -75,31 +92,113 @@ public:
 		// Allocate new memory
 		beta = new float[paramcount];
 		cout << "\nBeta memory allocated for " << paramcount << "elements\n";
+		resizeFeatures();
+	}
+
+	// Reallocate the shared feature vector for the larger of the live and requested lag counts
+	void resizeFeatures() {
+		featureLags = (beta != nullptr) ? stepbacks : 0;
+		if (requestedLags > featureLags)
+			featureLags = requestedLags;
+		if (features != nullptr)
+			delete[] features;
+		features = new float[PARAM_COUNT*featureLags + 1];
+		buildLagFeatures();
+	}
+
+	// Request that the feature vector carries at least this many lags (0 to release)
+	void requestFeatureLags(int lags) {
+		requestedLags = lags;
+		resizeFeatures();
 	}
 	
-	// Log EMG data
-	void addDataEMG(const int8_t* emg) {
+	// Select the held IMU sample valid at time t: the newest unless it is stamped after t.
+	// Returns -1 if none is usable or it is older than the gap threshold.
+	int heldIndex(const uint64_t *heldTime, int heldCount, uint64_t t) {
+		for (int i = 1; i >= 2 - heldCount; i--)
+			if (heldTime[i] <= t)
+				return (t - heldTime[i] > FUSION_GAP_US) ? -1 : i;
+		return -1;
+	}
+
+	// Log EMG data -- each EMG sample is one step of the fused time grid
+	void addDataEMG(const int8_t* emg, uint64_t timestamp) {
+		// EMG dropout (or time running backwards) breaks the lag history
+		bool dropout = (acquiredEMGSamples > 0) && ((timestamp < lastEMGTime) || (timestamp - lastEMGTime > FUSION_GAP_US));
+		lastEMGTime = timestamp;
 		// Store for screen update
 		bufferPosEMG = mod(bufferPosEMG + 1, BUFFER_SAMPLES);
 		for (int i = 0; i < 8; i++) {
 			emgSamples[bufferPosEMG][i] = abs( emg[i] );		// Store magnitude information only
 		}
 		acquiredEMGSamples += 1;
+
+		// Sample-and-hold IMU streams onto this EMG timestamp
+		int ia = heldIndex(accHeldTime, accHeldCount, timestamp);
+		int io = heldIndex(oriHeldTime, oriHeldCount, timestamp);
+		if (ia >= 0)
+			accSamples[bufferPosEMG] = accHeld[ia];
+		if (io >= 0)
+			oriSamples[bufferPosEMG] = oriHeld[io];
+		bool valid = (ia >= 0) && (io >= 0);
+		gap = (alignedSamples > 0) && (dropout || !valid);
+		historyReset = dropout || !valid;
+		if (historyReset) {
+			// Do not carry stimulation or smoothing across a break in the data
+			for (int k = 0; k < BUFFER_SAMPLES; k++)
+				bufferProb[k] = 0;
+			grasping = false;
+		}
+		if (!valid)
+			alignedSamples = 0;
+		else if (dropout)
+			alignedSamples = 1;
+		else if (alignedSamples < BUFFER_SAMPLES)
+			alignedSamples += 1;
+		buildLagFeatures();
 	}
 
 	// Log accelerometer data
-	void addDataAcc(myo::Vector3<float> accel) {
-		// Store for screen update
-		bufferPosAcc = mod(bufferPosAcc + 1, BUFFER_SAMPLES);		// Raw accelerometry
-		accSamples[bufferPosAcc] = accel;
-		acquiredAccSamples += 1;
+	void addDataAcc(myo::Vector3<float> accel, uint64_t timestamp) {
+		accHeld[0] = accHeld[1];
+		accHeldTime[0] = accHeldTime[1];
+		accHeld[1] = accel;									// Raw accelerometry
+		accHeldTime[1] = timestamp;
+		if (accHeldCount < 2)
+			accHeldCount += 1;
 	}
 
 	// Log orientation data
-	void addDataOri(myo::Quaternion<float> rotation) {
-		// Store for screen update
-		bufferPosOri = mod(bufferPosOri + 1, BUFFER_SAMPLES);		// Raw gyroscopic
-		oriSamples[bufferPosOri] = rotation;
+	void addDataOri(myo::Quaternion<float> rotation, uint64_t timestamp) {
+		oriHeld[0] = oriHeld[1];
+		oriHeldTime[0] = oriHeldTime[1];
+		oriHeld[1] = rotation;								// Raw gyroscopic
+		oriHeldTime[1] = timestamp;
+		if (oriHeldCount < 2)
+			oriHeldCount += 1;
+	}
+
+	// True if the last EMG sample broke the fused history (dropout or stale IMU)
+	bool gapDetected() {
+		return gap;
+	}
+
+	// Forget all stream history, e.g. when a new data file is started
+	void resetHistory() {
+		acquiredEMGSamples = 0;
+		alignedSamples = 0;
+		accHeldCount = 0;
+		oriHeldCount = 0;
+		gap = false;
+		historyReset = true;
+		for (int k = 0; k < BUFFER_SAMPLES; k++)
+			bufferProb[k] = 0;
+		grasping = false;
+	}
+
+	// True if the last EMG sample restarted the history (also at start-up and before IMU arrives)
+	bool wasHistoryReset() {
+		return historyReset;
 	}
 
 	// Return grasping state
@@ -138,6 +237,8 @@ public:
 		trained = false;
 		if (beta != nullptr)
 			delete[] beta;
+		beta = nullptr;
+		resizeFeatures();
 		return;
 	}
 
@@ -150,36 +251,61 @@ public:
 		return (a%b + b) % b;
 	}
 
-	void updateGraspState() {
-		// Only if trained
-		if (!trained)
-			return;
-		// Update grasp state -- perform logistic regression on history
-		if ((acquiredEMGSamples < stepbacks) || (acquiredAccSamples < stepbacks))
-			return;
-		
+	// Build lag feature vector x = [1, EMG(8 x lags), Acc(3 x lags), Ori(w,x,y,z x lags)]
+	// in the same channel order as the beta parameters. All lags are EMG sample steps on the
+	// fused grid; lags beyond alignedSamples are stale and must not be used by the caller.
+	void buildLagFeatures() {
+		float *x = features;
+		int lags = featureLags;
 		// Intercept
 		int ix = 0;
-		float t = beta[ix++];
+		x[ix++] = 1;
 		// EMG channels
 		int ch, k;
 		for (ch = 0; ch < 8; ch++)
-			for (k = 0; k < stepbacks; k++) {
-				t += beta[ix++] * emgSamples[mod(bufferPosEMG - k,BUFFER_SAMPLES)][ch];
-			}
+			for (k = 0; k < lags; k++)
+				x[ix++] = emgSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)][ch];
 		// Acc channels
 		for (ch = 0; ch < 3; ch++)
-			for (k = 0; k < stepbacks; k++)
-				t += beta[ix++] * accSamples[mod(bufferPosAcc - k, BUFFER_SAMPLES)][ch];
+			for (k = 0; k < lags; k++)
+				x[ix++] = accSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)][ch];
 		// Ori channels
-		for (k = 0; k < stepbacks; k++)
-			t += beta[ix++] * oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].w();
-		for (k = 0; k < stepbacks; k++)
-			t += beta[ix++] * oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].x();
-		for (k = 0; k < stepbacks; k++)
-			t += beta[ix++] * oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].y();
-		for (k = 0; k < stepbacks; k++)
-			t += beta[ix++] * oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].z();
+		for (k = 0; k < lags; k++)
+			x[ix++] = oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].w();
+		for (k = 0; k < lags; k++)
+			x[ix++] = oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].x();
+		for (k = 0; k < lags; k++)
+			x[ix++] = oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].y();
+		for (k = 0; k < lags; k++)
+			x[ix++] = oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].z();
+	}
+
+	const float* getLagFeatures() {
+		return features;
+	}
+
+	int getFeatureLags() {
+		return featureLags;
+	}
+
+	int getAlignedSamples() {
+		return alignedSamples;
+	}
+
+	void updateGraspState() {
+		// Only if trained
+		if (!trained)
+			return;
+		// Update grasp state -- perform logistic regression on history
+		if (alignedSamples < stepbacks)
+			return;
+
+		// Intercept, then each channel's lags (features may hold more lags than beta)
+		float t = beta[0] * features[0];
+		int ix, ch, k;
+		for (ch = 0; ch < PARAM_COUNT; ch++)
+			for (k = 0; k < stepbacks; k++)
+				t += beta[1 + ch*stepbacks + k] * features[1 + ch*featureLags + k];
 
 		// Logit function
 		bufferPosProb = mod(bufferPosProb + 1, BUFFER_SAMPLES);
@@ -198,18 +324,18 @@ public:
 				}
 			for (ch = 0; ch < 3; ch++)
 				for (k = 0; k < stepbacks; k++) {
-					debugfile << "b(" << ix << ")=" << beta[ix] << " " << bufferPosAcc << " " << bufferPosAcc - k << "," << BUFFER_SAMPLES << " [" << mod(bufferPosAcc - k, BUFFER_SAMPLES) << "][" << ch << "] " << accSamples[mod(bufferPosAcc - k, BUFFER_SAMPLES)][ch] << ": " << beta[ix] * accSamples[mod(bufferPosAcc - k, BUFFER_SAMPLES)][ch] << "\n";
+					debugfile << "b(" << ix << ")=" << beta[ix] << " " << bufferPosEMG << " " << bufferPosEMG - k << "," << BUFFER_SAMPLES << " [" << mod(bufferPosEMG - k, BUFFER_SAMPLES) << "][" << ch << "] " << accSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)][ch] << ": " << beta[ix] * accSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)][ch] << "\n";
 					ix++;
 				}
 			for (k = 0; k < stepbacks; k++) {
-				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].w() << "\n";
+				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].w() << "\n";
 			}
 			for (k = 0; k < stepbacks; k++)
-				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].x() << "\n";
+				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].x() << "\n";
 			for (k = 0; k < stepbacks; k++)
-				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].y() << "\n";
+				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].y() << "\n";
 			for (k = 0; k < stepbacks; k++)
-				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosOri - k, BUFFER_SAMPLES)].z() << "\n";
+				debugfile << "b(" << ix << ")=" << beta[ix++] << " " << oriSamples[mod(bufferPosEMG - k, BUFFER_SAMPLES)].z() << "\n";
 			debugfile << "\n t=" << t << " p=" << bufferProb[bufferPosProb];
 
 			debugfile.close();
@@ -234,6 +360,235 @@ public:
 	}
 };
 
+// Bank of candidate models evaluated side-by-side against the live stream (shadow mode).
+// Betas are stored feature-major (one row of N model weights per lag feature) so that
+// all N logits are produced in a single GEMV pass over the determinator's lag feature vector.
+class GraspModelBank {
+private:
+	bool debug = true;
+	int modelCount = 0;
+	int modelStride = 0;		// Row length, padded to a multiple of 8 for SIMD
+	int maxStepbacks = 0;
+	int featureCount = 0;
+	float *betaT = nullptr;		// featureCount x modelStride
+	float *logits = nullptr;
+	float *bufferProb = nullptr;	// modelCount x BUFFER_SAMPLES
+	int *probSmoothing = nullptr;
+	int *stepbacks = nullptr;
+	int bufferPosProb = 0;
+	std::string decisions;		// One '0'/'1' per model ('-' until first evaluated)
+	bool decisionsChanged = false;
+	std::vector<std::string> modelNames;
+
+	int mod(int a, int b)
+	{
+		return (a%b + b) % b;
+	}
+
+	void freeBank() {
+		if (betaT != nullptr)
+			delete[] betaT;
+		if (logits != nullptr)
+			delete[] logits;
+		if (bufferProb != nullptr)
+			delete[] bufferProb;
+		if (probSmoothing != nullptr)
+			delete[] probSmoothing;
+		if (stepbacks != nullptr)
+			delete[] stepbacks;
+		betaT = logits = bufferProb = nullptr;
+		probSmoothing = stepbacks = nullptr;
+		modelCount = 0;
+		modelNames.clear();
+		decisions.clear();
+	}
+
+public:
+	~GraspModelBank() {
+		freeBank();
+	}
+
+	// Load a bank definition file: one training parameters filename per line (same format
+	// as GraspDeterminator::loadTrainingParams). Relative names are taken from the bank's folder.
+	bool loadModelBank(std::string filename) {
+		std::string line, folder;
+		ifstream bankfile(filename);
+		if (!bankfile.is_open())
+			return false;
+		size_t slash = filename.find_last_of("\\/");
+		if (slash != std::string::npos)
+			folder = filename.substr(0, slash + 1);
+
+		// Read all models first -- the bank layout depends on the largest stepbacks
+		std::vector<int> stepbacksList, smoothingList;
+		std::vector<std::vector<float>> betaList;
+		std::vector<std::string> names;
+		while (getline(bankfile, line)) {
+			if (line.empty())
+				continue;
+			std::string modelfile = line;
+			if ((line.find(':') == std::string::npos) && (line[0] != '\\') && (line[0] != '/'))
+				modelfile = folder + line;
+			ifstream myfile(modelfile);
+			if (!myfile.is_open()) {
+				cout << "\nUnable to open bank model " << modelfile << "\n";
+				return false;
+			}
+			getline(myfile, line);
+			int stepbacks = (int) ::atof(line.c_str());
+			getline(myfile, line);
+			int smoothing = (int) ::atof(line.c_str());
+			if ((stepbacks < 1) || (stepbacks > BUFFER_SAMPLES) || (smoothing < 1) || (smoothing > BUFFER_SAMPLES)) {
+				cout << "\nInvalid parameters in bank model " << modelfile << "\n";
+				return false;
+			}
+			std::vector<float> beta(PARAM_COUNT*stepbacks + 1);
+			for (size_t k = 0; k < beta.size(); k++) {
+				getline(myfile, line);
+				beta[k] = (float) ::atof(line.c_str());
+			}
+			stepbacksList.push_back(stepbacks);
+			smoothingList.push_back(smoothing);
+			betaList.push_back(beta);
+			names.push_back(modelfile);
+		}
+		if (names.empty())
+			return false;
+
+		// Allocate bank
+		freeBank();
+		modelCount = (int)names.size();
+		modelStride = (modelCount + 7) & ~7;
+		maxStepbacks = 0;
+		for (int m = 0; m < modelCount; m++)
+			if (stepbacksList[m] > maxStepbacks)
+				maxStepbacks = stepbacksList[m];
+		featureCount = PARAM_COUNT*maxStepbacks + 1;
+		betaT = new float[featureCount*modelStride];
+		logits = new float[modelStride];
+		bufferProb = new float[modelCount*BUFFER_SAMPLES];
+		probSmoothing = new int[modelCount];
+		stepbacks = new int[modelCount];
+		for (int k = 0; k < featureCount*modelStride; k++)
+			betaT[k] = 0;
+
+		// Scatter each model's betas into the shared layout (unused lags remain zero)
+		for (int m = 0; m < modelCount; m++) {
+			int sb = stepbacksList[m];
+			betaT[m] = betaList[m][0];
+			for (int ch = 0; ch < PARAM_COUNT; ch++)
+				for (int k = 0; k < sb; k++)
+					betaT[(1 + ch*maxStepbacks + k)*modelStride + m] = betaList[m][1 + ch*sb + k];
+			probSmoothing[m] = smoothingList[m];
+			stepbacks[m] = sb;
+			if (debug) cout << " Bank model " << m << ": " << names[m] << " (stepbacks = " << sb << ", smoothing = " << smoothingList[m] << ")\n";
+		}
+		modelNames = names;
+		resetState();
+		return true;
+	}
+
+	// Clear probability history and force a full decision line at the next update
+	void resetState() {
+		for (int k = 0; k < modelCount*BUFFER_SAMPLES; k++)
+			bufferProb[k] = 0;
+		bufferPosProb = 0;
+		decisions.assign(modelCount, '-');
+		decisionsChanged = false;
+	}
+
+	// Mirror the determinator's reset after a gap: clear probabilities, no model grasping
+	void clearHistory() {
+		for (int k = 0; k < modelCount*BUFFER_SAMPLES; k++)
+			bufferProb[k] = 0;
+		for (int m = 0; m < modelCount; m++)
+			if (decisions[m] != '0') {
+				decisions[m] = '0';
+				decisionsChanged = true;
+			}
+	}
+
+	void unloadModelBank() {
+		freeBank();
+	}
+
+	bool isLoaded() {
+		return modelCount > 0;
+	}
+
+	int getModelCount() {
+		return modelCount;
+	}
+
+	std::string getModelName(int m) {
+		return modelNames[m];
+	}
+
+	int getMaxStepbacks() {
+		return maxStepbacks;
+	}
+
+	// Evaluate all models on the current history held by the determinator
+	void update(GraspDeterminator &grasp) {
+		decisionsChanged = false;
+		if (!isLoaded())
+			return;
+		if (grasp.wasHistoryReset())
+			clearHistory();
+		int available = grasp.getAlignedSamples();
+		if (available == 0)
+			return;
+		const float *features = grasp.getLagFeatures();
+		int lags = grasp.getFeatureLags();
+
+		// GEMV: logits = betaT' * features (inner loop runs across models, contiguous)
+		int ch, k, m;
+		for (m = 0; m < modelStride; m++)
+			logits[m] = betaT[m] * features[0];
+		for (ch = 0; ch < PARAM_COUNT; ch++)
+			for (k = 0; k < maxStepbacks; k++) {
+				const float x = features[1 + ch*lags + k];
+				const float *row = betaT + (1 + ch*maxStepbacks + k)*modelStride;
+				for (m = 0; m < modelStride; m++)
+					logits[m] += row[m] * x;
+			}
+
+		// Logit function, per-model smoothing and decisions. Models whose stepbacks exceed
+		// the available history are held back (zero probability, not grasping) as live would be.
+		bufferPosProb = mod(bufferPosProb + 1, BUFFER_SAMPLES);
+		for (m = 0; m < modelCount; m++) {
+			float *prob = bufferProb + m*BUFFER_SAMPLES;
+			char decision = '0';
+			if (stepbacks[m] <= available) {
+				prob[bufferPosProb] = 1 / (1 + exp(-logits[m]));
+				decision = (getSmoothedProb(m) > 0.5) ? '1' : '0';
+			} else
+				prob[bufferPosProb] = 0;
+			if (decisions[m] != decision) {
+				decisions[m] = decision;
+				decisionsChanged = true;
+			}
+		}
+	}
+
+	float getSmoothedProb(int m) {
+		const float *prob = bufferProb + m*BUFFER_SAMPLES;
+		float cumprob = 0;
+		for (int k = 0; k < probSmoothing[m]; k++)
+			cumprob += prob[mod(bufferPosProb - k, BUFFER_SAMPLES)];
+		return cumprob / probSmoothing[m];
+	}
+
+	// Decisions are only logged when any of them changes
+	bool hasDecisionChange() {
+		return decisionsChanged;
+	}
+
+	int getDecision(int m) {
+		return decisions[m] == '1';
+	}
+};
+
 class DataCollector : public myo::DeviceListener {
 public:
 	DataCollector() : emgSamples()
@@ -241,6 +596,7 @@ public:
 	}
 
 	GraspDeterminator grasp;
+	GraspModelBank bank;
 
 	std::array<int8_t, 8> emgSamples;
 	int intAnnotation;
@@ -271,16 +627,26 @@ public:
 		}
 
 		// Log data to grasp determinator
-		grasp.addDataEMG(emg);
+		grasp.addDataEMG(emg, timestamp);
+		if (grasp.gapDetected())
+			myfile << std::fixed << timestamp / 1e6 << "\tGAP\n";
 		grasp.updateGraspState();
 		if (grasp.isTrained())
 			myfile << std::fixed << timestamp / 1e6 << "\tSTIM\t" << grasp.isTrained() << "\t" << grasp.currentProb() << "\t" << grasp.getSmoothedProb() << "\n";
+		// Shadow-run model bank
+		bank.update(grasp);
+		if (bank.hasDecisionChange()) {
+			myfile << std::fixed << timestamp / 1e6 << "\tBANK";
+			for (int m = 0; m < bank.getModelCount(); m++)
+				myfile << "\t" << bank.getDecision(m);
+			myfile << "\n";
+		}
 	}
 
 	void onAccelerometerData(myo::Myo* myo, uint64_t timestamp, const myo::Vector3<float> &accel)
 	{
 		myfile << std::fixed << timestamp/1e6 << "\tACC\t" << accel[0] << "\t" << accel[1] << "\t" << accel[2] << "\n";
-		grasp.addDataAcc(accel);
+		grasp.addDataAcc(accel, timestamp);
 	}
 
 	void onGyroscopeData(myo::Myo* myo, uint64_t timestamp, const myo::Vector3<float> &gyro)
@@ -291,7 +657,7 @@ public:
 	void onOrientationData(myo::Myo* myo, uint64_t timestamp, const myo::Quaternion<float> &rotation)
 	{
 		myfile << std::fixed << timestamp / 1e6 << "\tORI\t" << rotation.w() << "\t" << rotation.x() << "\t" << rotation.y() << "\t" << rotation.z() << "\n";
-		grasp.addDataOri(rotation);
+		grasp.addDataOri(rotation, timestamp);
 	}
 
 	void onPose(myo::Myo* myo, uint64_t timestamp, myo::Pose &pose)
@@ -385,6 +751,33 @@ public:
 		return;
 	}
 
+	bool loadModelBank(std::string filename) {
+		if (!bank.loadModelBank(filename))
+			return false;
+		grasp.requestFeatureLags(bank.getMaxStepbacks());
+		return true;
+	}
+
+	void unloadModelBank() {
+		bank.unloadModelBank();
+		grasp.requestFeatureLags(0);
+	}
+
+	// Start each data file from a clean history so its output does not depend on earlier sessions
+	void beginFile() {
+		grasp.resetHistory();
+		logModelBank();
+	}
+
+	// Record model order so BANK decision columns can be decoded; each file starts afresh
+	void logModelBank() {
+		if (!bank.isLoaded())
+			return;
+		for (int m = 0; m < bank.getModelCount(); m++)
+			myfile << "0 PARAM BANKMODEL " << m << " " << bank.getModelName(m) << "\n";
+		bank.resetState();
+	}
+
 	void simulateInput(myo::Myo* myo, std::string filename) {
 		std::string line;
 		ifstream simfile;
@@ -394,6 +787,7 @@ public:
 			// Output filename
 			filename = filename + "_sim.txt";
 			myfile.open(filename);
+			beginFile();
 			// Read contents
 			while (getline(simfile, line)) {
 				char delimiter = '\t';
@@ -404,7 +798,7 @@ public:
 				pos = line.find(delimiter);
 				token = line.substr(0, pos);
 				line.erase(0, pos + 1);
-				uint64_t timestamp = (uint64_t)(::atof(token.c_str())*1e6);
+				uint64_t timestamp = (uint64_t)(::atof(token.c_str())*1e6 + 0.5);		// Round to recover the logged microseconds exactly
 
 				// Identifier
 				pos = line.find(delimiter);
@@ -508,7 +902,7 @@ int main(int argc, char** argv)
 			cout << ' ' << collector.getAnnotation(k) << '\n';
 		}
 
-		enum States { state_menu, state_acquire, state_loadtrain, state_unloadtrain, state_train, state_exit, state_sim, state_vibrate };
+		enum States { state_menu, state_acquire, state_loadtrain, state_unloadtrain, state_train, state_exit, state_sim, state_vibrate, state_loadbank, state_unloadbank };
 		States state = state_menu;
 		std::string filename, armside;
 		int ch; int annot = 0;
@@ -516,7 +910,7 @@ int main(int argc, char** argv)
 
 			switch (state) {
 			case state_menu:
-				cout << "\nMenu\n 1) Acquire data\n 2) Load training file\n 3) Unload training data\n 4) Train using recorded dataset\n 5) Simulate recording\n 6) Vibrate Myo\n 7) Quit\n:";
+				cout << "\nMenu\n 1) Acquire data\n 2) Load training file\n 3) Unload training data\n 4) Train using recorded dataset\n 5) Simulate recording\n 6) Vibrate Myo\n 7) Quit\n 8) Load model bank (shadow run)\n 9) Unload model bank\n:";
 				// Get option and flush buffer
 				fflush(stdin);
 				ch = getchar();
@@ -543,6 +937,12 @@ int main(int argc, char** argv)
 				case '7':
 					state = state_exit;
 					break;
+				case '8':
+					state = state_loadbank;
+					break;
+				case '9':
+					state = state_unloadbank;
+					break;
 				default:
 					cout << "\n\n--- Unknown option ---\n";
 				}
@@ -576,6 +976,7 @@ int main(int argc, char** argv)
 						break;
 					};
 				}
+				collector.beginFile();
 
 				// Main acquisition loop
 				cout << "\nAquiring data...\n press numpad <1,2,3> to vibrate\n press ESC to finish.\n";
@@ -614,6 +1015,19 @@ int main(int argc, char** argv)
 				state = state_menu;
 				break;
 
+			case state_loadbank:
+				cout << "\n\nSpecify model bank file (one training parameters file per line)...\n";
+				filename = collector.GetFileName("Model bank:");
+				if (!collector.loadModelBank(filename))
+					cout << "Unable to load model bank!\n";
+				state = state_menu;
+				break;
+
+			case state_unloadbank:
+				collector.unloadModelBank();
+				state = state_menu;
+				break;
+
 			case state_unloadtrain:
 				collector.unloadTrainingParams();
 				break;